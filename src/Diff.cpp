@@ -0,0 +1,428 @@
+#include "Diff.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace adapt;
+
+namespace {
+
+const char *const unresolvedTarget = "ERROR";
+
+// Resolves ACCESS statements of the revision without executing all keywords:
+// each statement sees only declarations made before it. Names are looked up
+// in indexes collected by the parser.
+class Resolver {
+ public:
+  explicit Resolver(const Revision &revision)
+      : m_keywords(revision.keywords), m_structure(revision.structure) {}
+  Resolver(Resolver &&) = default;
+  Resolver(const Resolver &) = delete;
+  Resolver &operator=(Resolver &&) = delete;
+  ~Resolver() = default;
+
+  // Returns full name of accessed entity or unresolvedTarget.
+  std::string Resolve(const size_t accessIndex) const {
+    const auto &access =
+        static_cast<const AccessKeyword &>(GetKeyword(accessIndex));
+    try {
+      const auto &target =
+          access.FindTarget([this, accessIndex](const std::string &name) {
+            return FindEntity(name, accessIndex);
+          });
+      // only declarations are accessible, SCOPE is not
+      if (!dynamic_cast<const DeclareKeyword *>(&target->GetRuntime())) {
+        return unresolvedTarget;
+      }
+      return target->GetName();
+    } catch (const BadLanguageException &) {
+      return unresolvedTarget;
+    }
+  }
+
+  // Calls back with index of each ACCESS statement which could access entity
+  // with the full name, could call back more than once for the same index.
+  template <typename Callback>
+  void ForEachAccess(const std::string &name, const Callback &callback) const {
+    // absolute argument or absolute USING path
+    ForEachAccess(name, name, 0, m_keywords.size(), callback);
+    // argument relative to the scope which is at the name start
+    const std::string delimiter = "::";
+    for (auto scopeEnd = name.find(delimiter); scopeEnd != std::string::npos;
+         scopeEnd = name.find(delimiter, scopeEnd + 1)) {
+      const auto &path = name.substr(0, scopeEnd + delimiter.size());
+      const auto &scopes = FindRange(m_structure.scopePaths, path);
+      if (scopes.first == scopes.second) {
+        // there are no nested scopes too
+        break;
+      }
+      const auto &nameEnd = name.substr(path.size());
+      for (auto it = scopes.first; it != scopes.second; ++it) {
+        const auto &scope = m_structure.scopes[it->second];
+        if (scope.path == path) {
+          ForEachAccess(name, nameEnd, scope.begin, scope.end, callback);
+        }
+      }
+    }
+  }
+
+ private:
+  // Calls back with index of each ACCESS statement from the range of keyword
+  // indexes, which is indexed by the name end and could access entity with
+  // the full name.
+  template <typename Callback>
+  void ForEachAccess(const std::string &name, const std::string &nameEnd,
+                     const size_t begin, const size_t end,
+                     const Callback &callback) const {
+    const auto hash = std::hash<std::string>()(nameEnd);
+    const auto &accesses = m_structure.accesses;
+    for (auto it = std::lower_bound(accesses.cbegin(), accesses.cend(),
+                                    std::make_pair(hash, begin));
+         it != accesses.cend() && it->first == hash && it->second < end;
+         ++it) {
+      const auto &access =
+          static_cast<const AccessKeyword &>(GetKeyword(it->second));
+      const auto &directNames = access.GetDirectNames();
+      const auto &altNames = access.GetAltNames();
+      if (std::find(directNames.cbegin(), directNames.cend(), name) !=
+              directNames.cend() ||
+          std::find(altNames.cbegin(), altNames.cend(), name) !=
+              altNames.cend()) {
+        callback(it->second);
+      }
+    }
+  }
+
+  const Keyword &GetKeyword(const size_t index) const {
+    return *m_keywords[index];
+  }
+
+  std::shared_ptr<const Environment::Entity> FindEntity(
+      const std::string &name, const size_t before) const {
+    const auto &range = FindRange(m_structure.declarations, name);
+    for (auto it = range.first; it != range.second && it->second < before;
+         ++it) {
+      const auto &entity =
+          static_cast<const EnvironmentEntityKeyword &>(GetKeyword(it->second));
+      // declaration with invalid name is not registered, the next one with
+      // the same full name is registered instead
+      if (entity.GetName() == name &&
+          Environment::IsValidName(entity.GetArg())) {
+        return std::make_shared<Environment::Entity>(name,
+                                                     m_keywords[it->second]);
+      }
+    }
+    return {};
+  }
+
+  static std::pair<SourceNameIndex::const_iterator,
+                   SourceNameIndex::const_iterator>
+  FindRange(const SourceNameIndex &index, const std::string &name) {
+    const auto hash = std::hash<std::string>()(name);
+    return {std::lower_bound(index.cbegin(), index.cend(),
+                             std::make_pair(hash, size_t(0))),
+            std::upper_bound(
+                index.cbegin(), index.cend(),
+                std::make_pair(hash, std::numeric_limits<size_t>::max()))};
+  }
+
+ private:
+  const std::vector<std::shared_ptr<Keyword>> &m_keywords;
+  const SourceStructure &m_structure;
+};
+
+// Marks the longest strictly increasing subsequence.
+std::vector<bool> MarkLongestIncreasing(const std::vector<size_t> &sequence) {
+  std::vector<size_t> tails;
+  std::vector<size_t> prev(sequence.size());
+  for (size_t i = 0; i < sequence.size(); ++i) {
+    const auto &it = std::lower_bound(
+        tails.begin(), tails.end(), sequence[i],
+        [&sequence](size_t index, size_t value) {
+          return sequence[index] < value;
+        });
+    prev[i] = it == tails.begin() ? sequence.size() : *(it - 1);
+    if (it == tails.end()) {
+      tails.push_back(i);
+    } else {
+      *it = i;
+    }
+  }
+  std::vector<bool> result(sequence.size(), false);
+  for (auto i = tails.empty() ? sequence.size() : tails.back();
+       i != sequence.size(); i = prev[i]) {
+    result[i] = true;
+  }
+  return result;
+}
+
+class RevisionsDiff {
+ private:
+  struct Side {
+    const Revision &revision;
+    const Resolver resolver;
+    // ACCESS statements from changed scopes by key which is the same for the
+    // statement in both revisions
+    std::unordered_map<std::string, size_t> accesses;
+  };
+
+  // Declaration or nested scope, they are compared by position in the scope.
+  // ACCESS statements are not items, they are compared for each changed scope.
+  struct Item {
+    // full name of declaration or full path of nested scope, so DECLARE and
+    // SCOPE with the same name are not matched
+    const std::string *name;
+    size_t keyword;
+    // nested scope index or noScope for declaration
+    size_t scope;
+  };
+  static constexpr size_t noScope = std::numeric_limits<size_t>::max();
+
+  // Range of keywords from scopes with the same hash.
+  struct IdenticalRange {
+    size_t newBegin;
+    size_t oldBegin;
+    size_t size;
+  };
+
+  // Removed resolutions are reported first in order of old revision, then
+  // changed and added ones in order of new revision.
+  struct Change {
+    bool isRemoved;
+    // keyword index in the revision where the change is
+    size_t index;
+    std::string report;
+  };
+
+ public:
+  explicit RevisionsDiff(const Revision &oldRevision,
+                         const Revision &newRevision)
+      : m_old{oldRevision, Resolver(oldRevision), {}},
+        m_new{newRevision, Resolver(newRevision), {}} {}
+  RevisionsDiff(RevisionsDiff &&) = delete;
+  RevisionsDiff(const RevisionsDiff &) = delete;
+  RevisionsDiff &operator=(RevisionsDiff &&) = delete;
+  ~RevisionsDiff() = default;
+
+  std::vector<std::string> Run() {
+    // the first scope is the root
+    if (m_old.revision.structure.scopes[0].hash ==
+        m_new.revision.structure.scopes[0].hash) {
+      return {};
+    }
+    CompareScopes(0, 0);
+
+    for (const auto &keys : m_old.accesses) {
+      const auto &newAccess = m_new.accesses.find(keys.first);
+      if (newAccess == m_new.accesses.cend()) {
+        AddRemoved(keys.second);
+      } else {
+        CompareAccesses(keys.second, newAccess->second);
+      }
+    }
+    for (const auto &keys : m_new.accesses) {
+      if (!m_old.accesses.count(keys.first)) {
+        AddAdded(keys.second);
+      }
+    }
+    for (const auto &indexes : FindAccessesToChangedDeclarations()) {
+      CompareAccesses(indexes.second, indexes.first);
+    }
+
+    std::sort(m_changes.begin(), m_changes.end(),
+              [](const Change &lhs, const Change &rhs) {
+                if (lhs.isRemoved != rhs.isRemoved) {
+                  return lhs.isRemoved;
+                }
+                return lhs.index < rhs.index;
+              });
+    std::vector<std::string> result;
+    result.reserve(m_changes.size());
+    for (auto &change : m_changes) {
+      result.push_back(std::move(change.report));
+    }
+    return result;
+  }
+
+ private:
+  void CompareScopes(const size_t oldIndex, const size_t newIndex) {
+    const auto &oldScope = m_old.revision.structure.scopes[oldIndex];
+    const auto &newScope = m_new.revision.structure.scopes[newIndex];
+    if (oldScope.hash == newScope.hash) {
+      m_identical.push_back({newScope.begin, oldScope.begin,
+                             newScope.end - newScope.begin});
+      return;
+    }
+
+    const auto &oldItems = CollectAccesses(m_old, oldIndex);
+    const auto &newItems = CollectAccesses(m_new, newIndex);
+
+    // items are matched by name, items with the same name (which is the error)
+    // are matched in order of occurrence
+    std::unordered_map<std::string, std::vector<size_t>> oldNames;
+    for (auto i = oldItems.size(); i > 0; --i) {
+      // reversed order, so the next item to match is at the back
+      oldNames[*oldItems[i - 1].name].push_back(i - 1);
+    }
+    std::vector<size_t> oldPositions;
+    std::vector<size_t> newMatched;
+    std::vector<bool> isOldMatched(oldItems.size(), false);
+    for (size_t i = 0; i < newItems.size(); ++i) {
+      const auto &old = oldNames.find(*newItems[i].name);
+      if (old == oldNames.cend() || old->second.empty()) {
+        CollectItem(m_new, newItems[i]);
+        continue;
+      }
+      oldPositions.push_back(old->second.back());
+      old->second.pop_back();
+      newMatched.push_back(i);
+      isOldMatched[oldPositions.back()] = true;
+    }
+    for (size_t i = 0; i < oldItems.size(); ++i) {
+      if (!isOldMatched[i]) {
+        CollectItem(m_old, oldItems[i]);
+      }
+    }
+
+    // moved items change order of declarations, so they are changed entirely
+    const auto &isInOrder = MarkLongestIncreasing(oldPositions);
+    for (size_t i = 0; i < newMatched.size(); ++i) {
+      const auto &oldItem = oldItems[oldPositions[i]];
+      const auto &newItem = newItems[newMatched[i]];
+      if (!isInOrder[i]) {
+        CollectItem(m_old, oldItem);
+        CollectItem(m_new, newItem);
+      } else if (newItem.scope != noScope) {
+        CompareScopes(oldItem.scope, newItem.scope);
+      }
+    }
+  }
+
+  // Collects ACCESS statements of the scope as changed, nested scopes are not
+  // included. Returns declarations and nested scopes of the scope.
+  std::vector<Item> CollectAccesses(Side &side, const size_t index) {
+    const auto &scopes = side.revision.structure.scopes;
+    const auto &scope = scopes[index];
+    const auto &keywords = side.revision.keywords;
+    std::vector<Item> items;
+    std::unordered_map<std::string, size_t> ordinals;
+    auto child = scope.children.cbegin();
+    for (auto i = scope.begin; i < scope.end; ++i) {
+      const auto *const keyword = keywords[i].get();
+      if (const auto *const access =
+              dynamic_cast<const AccessKeyword *>(keyword)) {
+        std::ostringstream key;
+        key << scope.path << ' ' << scope.occurrence << ' '
+            << access->GetArg() << ' ' << ordinals[access->GetArg()]++;
+        side.accesses.emplace(key.str(), i);
+        continue;
+      }
+      if (child != scope.children.cend() && i + 1 == scopes[*child].begin) {
+        // SCOPE keyword of the nested scope
+        items.push_back({&scopes[*child].path, i, *child});
+        i = scopes[*child].end - 1;
+        ++child;
+        continue;
+      }
+      items.push_back(
+          {&static_cast<const EnvironmentEntityKeyword *>(keyword)->GetName(),
+           i, noScope});
+    }
+    return items;
+  }
+
+  // Collects the declaration or the nested scope entirely as changed.
+  void CollectItem(Side &side, const Item &item) {
+    m_declarations.insert(static_cast<const EnvironmentEntityKeyword &>(
+                              *side.revision.keywords[item.keyword])
+                              .GetName());
+    if (item.scope == noScope) {
+      return;
+    }
+    for (const auto &nested : CollectAccesses(side, item.scope)) {
+      CollectItem(side, nested);
+    }
+  }
+
+  // Finds ACCESS statements from not changed scopes which could see changed
+  // declarations. Returns new revision index to old revision index.
+  std::map<size_t, size_t> FindAccessesToChangedDeclarations() {
+    std::sort(m_identical.begin(), m_identical.end(),
+              [](const IdenticalRange &lhs, const IdenticalRange &rhs) {
+                return lhs.newBegin < rhs.newBegin;
+              });
+    std::map<size_t, size_t> result;
+    if (m_declarations.empty()) {
+      return result;
+    }
+    for (const auto &name : m_declarations) {
+      m_new.resolver.ForEachAccess(name, [this, &result](const size_t index) {
+        auto range = std::upper_bound(
+            m_identical.cbegin(), m_identical.cend(), index,
+            [](size_t value, const IdenticalRange &range) {
+              return value < range.newBegin;
+            });
+        if (range == m_identical.cbegin()) {
+          return;
+        }
+        --range;
+        if (index < range->newBegin + range->size) {
+          result.emplace(index, range->oldBegin + (index - range->newBegin));
+        }
+      });
+    }
+    return result;
+  }
+
+  void CompareAccesses(const size_t oldIndex, const size_t newIndex) {
+    const auto &oldTarget = m_old.resolver.Resolve(oldIndex);
+    const auto &newTarget = m_new.resolver.Resolve(newIndex);
+    if (oldTarget == newTarget) {
+      return;
+    }
+    std::ostringstream out;
+    out << "CHANGED LINE " << GetLine(m_old, oldIndex) << " ACCESS "
+        << oldTarget << " TO LINE " << GetLine(m_new, newIndex) << " ACCESS "
+        << newTarget;
+    m_changes.push_back({false, newIndex, out.str()});
+  }
+
+  void AddRemoved(const size_t index) {
+    std::ostringstream out;
+    out << "REMOVED LINE " << GetLine(m_old, index) << " ACCESS "
+        << m_old.resolver.Resolve(index);
+    m_changes.push_back({true, index, out.str()});
+  }
+
+  void AddAdded(const size_t index) {
+    std::ostringstream out;
+    out << "ADDED LINE " << GetLine(m_new, index) << " ACCESS "
+        << m_new.resolver.Resolve(index);
+    m_changes.push_back({false, index, out.str()});
+  }
+
+  static size_t GetLine(const Side &side, const size_t index) {
+    return side.revision.keywords[index]->GetCodeSource().line;
+  }
+
+ private:
+  Side m_old;
+  Side m_new;
+
+  // full names of added, removed or moved declarations, in any revision
+  std::unordered_set<std::string> m_declarations;
+  std::vector<IdenticalRange> m_identical;
+
+  std::vector<Change> m_changes;
+};
+
+}  // namespace
+
+std::vector<std::string> adapt::Diff(const Revision &oldRevision,
+                                     const Revision &newRevision) {
+  return RevisionsDiff(oldRevision, newRevision).Run();
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Parser.hpp"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace adapt {
+
+struct Revision {
+  std::vector<std::shared_ptr<Keyword>> keywords;
+  SourceStructure structure;
+};
+
+// Compares ACCESS resolutions of two source revisions. Scopes with the same
+// structural hash are skipped, so only ACCESS statements from changed scopes
+// and ACCESS statements which could see changed declarations are resolved.
+// Returns report lines about added, removed and changed resolutions.
+std::vector<std::string> Diff(const Revision &oldRevision,
+                              const Revision &newRevision);
+
+}  // namespace adapt
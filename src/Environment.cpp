@@ -14,12 +14,16 @@ const std::string &Environment::Entity::GetName() const { return m_name; }
 
 const Keyword &Environment::Entity::GetRuntime() const { return *m_runtime; }
 
+bool Environment::IsValidName(const std::string &name) {
+  static const std::regex nameRule(R"([a-z][a-z\d]*)",
+                                   std::regex_constants::icase);
+  return std::regex_match(name, nameRule);
+}
+
 bool Environment::RegisterEntity(const std::string &name,
                                  std::string path,
                                  std::shared_ptr<const Keyword> runtime) {
-  static const std::regex nameRule(R"([a-z][a-z\d]*)",
-                                   std::regex_constants::icase);
-  if (!std::regex_match(name, nameRule)) {
+  if (!IsValidName(name)) {
     throw BadLanguageException(
         runtime->GetCodeSource(),
         "declaration \"" + name + R"(" has invalid format)");
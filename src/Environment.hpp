@@ -35,6 +35,8 @@ class Environment {
   Environment &operator=(Environment &&) = default;
   ~Environment() = default;
 
+  static bool IsValidName(const std::string &);
+
   bool RegisterEntity(const std::string &name,
                       std::string path,
                       std::shared_ptr<const Keyword>);
@@ -62,7 +62,6 @@ class EnvironmentEntityKeyword : public Keyword,
     throw Details::AccessInaccessibleException();
   }
 
- protected:
   const std::string &GetArg() const { return m_arg; }
   const std::string &GetName() const { return m_name; }
 
@@ -96,15 +95,32 @@ class AccessKeyword : public Keyword {
   ~AccessKeyword() override = default;
 
   void Execute(Environment &env) const override {
+    const auto &target = FindTarget(
+        [&env](const std::string &name) { return env.FindEntity(name); });
+    try {
+      target->GetRuntime().Access(env, *this);
+    } catch (const Details::AccessInaccessibleException &) {
+      throw BadLanguageException(
+          GetCodeSource(),
+          R"(attempt to access incaccessble item with name ")" +
+              target->GetName() + "\"");
+    }
+  }
+
+  // Finds accessed entity by provided lookup, throws BadLanguageException if
+  // the entity could not be found or is ambiguous.
+  template <typename Find>
+  std::shared_ptr<const Environment::Entity> FindTarget(
+      const Find &find) const {
     std::shared_ptr<const Environment::Entity> target;
     for (auto it = m_directNames.rbegin(); it != m_directNames.crend(); ++it) {
-      target = env.FindEntity(*it);
+      target = find(*it);
       if (target) {
         break;
       }
     }
     for (auto it = m_altNames.rbegin(); it != m_altNames.crend(); ++it) {
-      auto entity = env.FindEntity(*it);
+      auto entity = find(*it);
       if (!entity) {
         continue;
       }
@@ -123,21 +139,19 @@ class AccessKeyword : public Keyword {
       throw BadLanguageException(
           GetCodeSource(), R"(declaration ")" + m_arg + R"(" is not existent)");
     }
-
-    try {
-      target->GetRuntime().Access(env, *this);
-    } catch (const Details::AccessInaccessibleException &) {
-      throw BadLanguageException(
-          GetCodeSource(),
-          R"(attempt to access incaccessble item with name ")" +
-              target->GetName() + "\"");
-    }
+    return target;
   }
 
   void Access(Environment &, const Keyword &) const override {
     throw Details::AccessInaccessibleException();
   }
 
+  const std::string &GetArg() const { return m_arg; }
+  const std::vector<std::string> &GetDirectNames() const {
+    return m_directNames;
+  }
+  const std::vector<std::string> &GetAltNames() const { return m_altNames; }
+
  private:
   const std::string m_arg;
   const std::vector<std::string> m_directNames;
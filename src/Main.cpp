@@ -1,9 +1,10 @@
 
+#include "Diff.hpp"
 #include "Parser.hpp"
+#include "Source.hpp"
 
 #include <string.h>
 
-#include <fstream>
 #include <iostream>
 
 using namespace adapt;
@@ -18,52 +19,101 @@ void PrintError(const Exception &ex, const bool debug) {
   std::cout << std::endl;
 }
 
-bool ReadArgs(int argc, char *argv[], const char *&file, bool &debug) {
+bool ReadArgs(int argc,
+              char *argv[],
+              const char *&file,
+              const char *&diffFile,
+              bool &debug) {
   if (argc >= 2 && argv[1][0]) {
     file = &argv[1][0];
+    diffFile = nullptr;
     debug = false;
+    bool isValid = true;
     for (int i = 2; i < argc; ++i) {
       if (strcmp(&argv[i][0], "--debug") == 0) {
         debug = true;
-        break;
+      } else if (strcmp(&argv[i][0], "--diff") == 0) {
+        if (i + 1 >= argc || !argv[i + 1][0]) {
+          // new file name is required for diff
+          isValid = false;
+          break;
+        }
+        diffFile = &argv[++i][0];
       }
     }
-    return true;
+    if (isValid) {
+      return true;
+    }
   }
   if (argc == 0) {
     std::cout << "Wrong arguments." << std::endl;
   } else {
     std::cout << "Usage:" << std::endl
-              << "\t" << argv[0] << R"( "fileName">" [ --debug ], where:)"
+              << "\t" << argv[0]
+              << R"( "fileName">" [ --diff <newFileName> ] [ --debug ], where:)"
               << std::endl
               << std::endl
               << "\t\t <fileName>: path to input file, required;" << std::endl
+              << "\t\t --diff: compare ACCESS resolutions of <fileName> with "
+                 "<newFileName>, optional;"
+              << std::endl
               << "\t\t --debug: enable additional debuging inforamtion if set, "
                  "optional;"
               << std::endl;
   }
   return false;
 }
+
+std::unique_ptr<std::istream> OpenSourceFile(const char *path) {
+  auto result = OpenSource(path);
+  if (!result) {
+    std::cout << "Filed to open source file \"" << path << "\"." << std::endl;
+  }
+  return result;
+}
+
+bool ReadRevision(const char *path, Revision &revision, const bool debug) {
+  const auto source = OpenSourceFile(path);
+  if (!source) {
+    return false;
+  }
+  revision.keywords = Parse(
+      *source, [&debug](const Exception &ex) { PrintError(ex, debug); },
+      revision.structure);
+  return true;
+}
 }  // namespace
 
 int main(int argc, char *argv[]) {
   bool debug = false;
   const char *sourceFilePath;
+  const char *diffSourceFilePath;
 
   try {
-    if (!ReadArgs(argc, argv, sourceFilePath, debug)) {
+    if (!ReadArgs(argc, argv, sourceFilePath, diffSourceFilePath, debug)) {
       return 1;
     }
 
-    std::fstream source(sourceFilePath);
+    if (diffSourceFilePath) {
+      Revision oldRevision;
+      Revision newRevision;
+      if (!ReadRevision(sourceFilePath, oldRevision, debug) ||
+          !ReadRevision(diffSourceFilePath, newRevision, debug)) {
+        return 1;
+      }
+      for (const auto &line : Diff(oldRevision, newRevision)) {
+        std::cout << line << std::endl;
+      }
+      return 0;
+    }
+
+    const auto source = OpenSourceFile(sourceFilePath);
     if (!source) {
-      std::cout << "Filed to open source file \"" << sourceFilePath << "\"."
-                << std::endl;
       return 1;
     }
 
-    const auto &keywords =
-        Parse(source, [&debug](const Exception &ex) { PrintError(ex, debug); });
+    const auto &keywords = Parse(
+        *source, [&debug](const Exception &ex) { PrintError(ex, debug); });
 
     Environment env;
     bool hasErrors = false;
@@ -5,13 +5,50 @@
 #include "Keyword.hpp"
 #include "Types.hpp"
 
+#include <algorithm>
 #include <functional>
 #include <istream>
+#include <iterator>
 #include <sstream>
 #include <unordered_map>
 #include <vector>
 
 namespace adapt {
+
+// Scope of parsed source with structural hash of its content. The hash does
+// not depend on lines and spaces, so the same hash means the same keywords
+// and the same USING state at the scope start.
+struct SourceScope {
+  // full path with path delimiter at the end
+  std::string path;
+  size_t hash;
+  // range of keyword indexes inside the scope, nested scopes included
+  size_t begin;
+  size_t end;
+  // indexes of nested scopes in source order
+  std::vector<size_t> children;
+  // number of previous scopes with the same path, it is not zero only for
+  // duplicated scopes
+  size_t occurrence;
+};
+
+// Indexes by hash of name, sorted by hash and then by index. Hashes allow to
+// not copy names, a collision has to be checked by the user.
+using SourceNameIndex = std::vector<std::pair<size_t, size_t>>;
+
+// Scopes and names of parsed source, collected while parsing, so the source
+// could be analyzed without executing it.
+struct SourceStructure {
+  // the first scope is the root
+  std::vector<SourceScope> scopes;
+  // scope indexes by scope path
+  SourceNameIndex scopePaths;
+  // declaration keyword indexes (SCOPE included) by full name
+  SourceNameIndex declarations;
+  // ACCESS keyword indexes by argument and by argument with USING path
+  SourceNameIndex accesses;
+};
+
 namespace Details {
 
 inline bool IsNewLine(const char ch) { return ch == '\r' || ch == '\n'; }
@@ -21,6 +58,10 @@ inline bool IsScopeEnd(const char ch) { return ch == '}'; }
 inline bool IsKeywordEnd(const char ch) { return ch == ';'; }
 inline bool IsKeywordPathDel(const char ch) { return ch == ':'; }
 
+inline void CombineHash(size_t &seed, const size_t value) {
+  seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
 template <typename Char>
 struct NamesPolicy {};
 
@@ -54,10 +95,14 @@ class ParserSession {
  public:
   explicit ParserSession(SourceStream &source,
                          std::vector<std::shared_ptr<Keyword>> &resultRef,
+                         SourceStructure *structure,
                          std::function<void(const Exception &)> handleError)
       : m_source(source),
         m_handleError(std::move(handleError)),
-        m_result(resultRef) {}
+        m_result(resultRef),
+        m_structure(structure) {
+    OpenSourceScope();
+  }
   ParserSession(ParserSession &&) = default;
   ParserSession(const ParserSession &) = delete;
   ParserSession &operator=(ParserSession &&) = default;
@@ -82,13 +127,22 @@ class ParserSession {
       // one scope - is root scope
       throw SyntaxError(m_codeSource, "not all scopes are closed");
     }
+    CloseSourceScope();
+    SortSourceIndexes();
   }
 
  private:
   bool CheckNewLine(const Char &ch) {
+    const auto isCarriageReturn = m_isCarriageReturn;
+    m_isCarriageReturn = ch == '\r';
     if (!IsNewLine(ch)) {
       return false;
     }
+    if (isCarriageReturn && ch == '\n') {
+      // "\r\n" is one line end, the line is already counted by '\r'
+      m_codeSource.column = 0;
+      return true;
+    }
     if (!IsComment() && !m_keywordName.empty()) {
       throw SyntaxError(m_codeSource, "keyword is not finished");
     }
@@ -148,6 +202,7 @@ class ParserSession {
             "number of scope ends is not the same as number of scope starts");
       }
       m_scope.pop_back();
+      CloseSourceScope();
       return;
     }
 
@@ -166,6 +221,7 @@ class ParserSession {
       throw SyntaxError(m_codeSource,
                         R"(unknown keyword ")" + m_keywordName + "\"");
     }
+    HashKeyword();
     factory->second(ch);
     m_keywordName.clear();
     m_keywordArgs.clear();
@@ -180,6 +236,7 @@ class ParserSession {
   void CreateScopeKeyword(const Char &ch) {
     ValidateKeyword<1, true>(ch);
     auto name = m_scope.back() + m_keywordArgs[0];
+    IndexDeclaration(name);
     // caches all possible scopes, prepares it for future declarations and
     // accessors
     m_scope.push_back(name + Names::GetScopePathDel());
@@ -187,10 +244,12 @@ class ParserSession {
     // creating keyword with full path
     m_result.emplace_back(std::make_shared<EnvironmentEntityKeyword>(
         std::move(m_keywordArgs[0]), std::move(name), m_codeSource));
+    OpenSourceScope();
   }
 
   void CreateDeclareKeyword(const Char &ch) {
     ValidateKeyword<1, false>(ch);
+    IndexDeclaration(m_scope.back() + m_keywordArgs[0]);
     // creating keyword with full path
     m_result.emplace_back(std::make_shared<DeclareKeyword>(
         std::move(m_keywordArgs[0]), m_scope.back() + m_keywordArgs[0],
@@ -199,6 +258,7 @@ class ParserSession {
 
   void CreateAccessKeyword(const Char &ch) {
     ValidateKeyword<1, false>(ch);
+    IndexAccess();
     if (IsRoot(m_keywordArgs[0])) {
       // has only one variant as in the path provided as an absolute path from
       // root
@@ -231,6 +291,93 @@ class ParserSession {
         std::move(altNames), m_codeSource));
   }
 
+  // ACCESS is indexed by its argument and by its argument with USING path,
+  // these are ends of all its possible names.
+  void IndexAccess() {
+    if (!m_structure) {
+      return;
+    }
+    const std::hash<String> hash;
+    m_structure->accesses.emplace_back(hash(m_keywordArgs[0]),
+                                       m_result.size());
+    if (!m_using.empty()) {
+      m_structure->accesses.emplace_back(hash(m_using + m_keywordArgs[0]),
+                                         m_result.size());
+    }
+  }
+
+  void IndexDeclaration(const String &name) {
+    if (m_structure) {
+      m_structure->declarations.emplace_back(std::hash<String>()(name),
+                                             m_result.size());
+    }
+  }
+
+  void HashKeyword() {
+    if (!m_structure) {
+      return;
+    }
+    auto hash = std::hash<String>()(m_keywordName);
+    for (const auto &arg : m_keywordArgs) {
+      if (!arg.empty()) {
+        CombineHash(hash, std::hash<String>()(arg));
+      }
+    }
+    CombineHash(m_structure->scopes[m_sourceScopeIndexes.back()].hash, hash);
+  }
+
+  void OpenSourceScope() {
+    if (!m_structure) {
+      return;
+    }
+    auto &scopes = m_structure->scopes;
+    const auto index = scopes.size();
+    if (!m_sourceScopeIndexes.empty()) {
+      scopes[m_sourceScopeIndexes.back()].children.push_back(index);
+    }
+    m_sourceScopeIndexes.push_back(index);
+    m_structure->scopePaths.emplace_back(std::hash<String>()(m_scope.back()),
+                                         index);
+    // USING state is inherited by the scope, so it is a part of the content
+    scopes.push_back({m_scope.back(), std::hash<String>()(m_using),
+                      m_result.size(), 0, {}, 0});
+  }
+
+  void CloseSourceScope() {
+    if (!m_structure) {
+      return;
+    }
+    auto &scope = m_structure->scopes[m_sourceScopeIndexes.back()];
+    scope.end = m_result.size();
+    m_sourceScopeIndexes.pop_back();
+    if (!m_sourceScopeIndexes.empty()) {
+      CombineHash(m_structure->scopes[m_sourceScopeIndexes.back()].hash,
+                  scope.hash);
+    }
+  }
+
+  void SortSourceIndexes() {
+    if (!m_structure) {
+      return;
+    }
+    std::sort(m_structure->declarations.begin(),
+              m_structure->declarations.end());
+    std::sort(m_structure->accesses.begin(), m_structure->accesses.end());
+    auto &paths = m_structure->scopePaths;
+    std::sort(paths.begin(), paths.end());
+    auto &scopes = m_structure->scopes;
+    for (auto it = paths.cbegin(); it != paths.cend(); ++it) {
+      // the same scope is earlier with the same hash, if it is duplicated
+      for (auto prev = std::make_reverse_iterator(it);
+           prev != paths.crend() && prev->first == it->first; ++prev) {
+        if (scopes[prev->second].path == scopes[it->second].path) {
+          scopes[it->second].occurrence = scopes[prev->second].occurrence + 1;
+          break;
+        }
+      }
+    }
+  }
+
   bool IsComment() const { return m_commentStartLineNo == m_codeSource.line; }
 
   template <size_t argsNoReq, bool isScope>
@@ -282,8 +429,13 @@ class ParserSession {
 
   size_t m_commentStartLineNo = 0;
   size_t m_commentStartsNo = 0;
+  // previous symbol is '\r'
+  bool m_isCarriageReturn = false;
 
   std::vector<std::shared_ptr<Keyword>> &m_result;
+
+  SourceStructure *const m_structure;
+  std::vector<size_t> m_sourceScopeIndexes;
 };  // namespace Details
 
 }  // namespace Details
@@ -292,7 +444,18 @@ template <typename Char, typename ErrorHandeler>
 std::vector<std::shared_ptr<Keyword>> Parse(std::basic_istream<Char> &source,
                                             const ErrorHandeler &handleError) {
   std::vector<std::shared_ptr<Keyword>> result;
-  Details::ParserSession<Char>(source, result, handleError).Parse();
+  Details::ParserSession<Char>(source, result, nullptr, handleError).Parse();
+  return result;
+}
+
+// Parses source and collects its structure.
+template <typename Char, typename ErrorHandeler>
+std::vector<std::shared_ptr<Keyword>> Parse(std::basic_istream<Char> &source,
+                                            const ErrorHandeler &handleError,
+                                            SourceStructure &structure) {
+  std::vector<std::shared_ptr<Keyword>> result;
+  Details::ParserSession<Char>(source, result, &structure, handleError)
+      .Parse();
   return result;
 }
 }  // namespace adapt
@@ -0,0 +1,349 @@
+#include "Source.hpp"
+
+#include <zlib.h>
+#ifdef ADAPT_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <initializer_list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace adapt;
+
+namespace {
+
+// Size of one decompressed block which is passed to the parser and size of
+// compressed chunk read from file.
+const size_t blockSize = 64 * 1024;
+// Number of decompressed blocks which could be prepared ahead of the parser.
+const size_t numberOfBlocks = 4;
+
+class Decompressor {
+ public:
+  explicit Decompressor(std::unique_ptr<std::istream> source)
+      : m_source(std::move(source)), m_input(blockSize) {}
+  Decompressor(Decompressor &&) = delete;
+  Decompressor(const Decompressor &) = delete;
+  Decompressor &operator=(Decompressor &&) = delete;
+  virtual ~Decompressor() = default;
+
+  // Fills buffer by decompressed data, returns number of bytes written. The
+  // buffer is filled completely if the end of source is not reached, so zero
+  // means the end of source.
+  virtual size_t Read(char *buffer, size_t size) = 0;
+
+ protected:
+  // Reads next compressed chunk, returns false if the end of source is reached.
+  bool ReadInput() {
+    if (m_isInputEnd) {
+      return false;
+    }
+    m_source->read(m_input.data(), m_input.size());
+    if (m_source->bad()) {
+      throw SourceError("failed to read source file");
+    }
+    m_inputSize = static_cast<size_t>(m_source->gcount());
+    m_isInputEnd = m_inputSize == 0;
+    return !m_isInputEnd;
+  }
+
+  const char *GetInput() const { return m_input.data(); }
+  size_t GetInputSize() const { return m_inputSize; }
+
+ private:
+  const std::unique_ptr<std::istream> m_source;
+  std::vector<char> m_input;
+  size_t m_inputSize = 0;
+  bool m_isInputEnd = false;
+};
+
+class GzipDecompressor : public Decompressor {
+ public:
+  explicit GzipDecompressor(std::unique_ptr<std::istream> source)
+      : Decompressor(std::move(source)) {
+    // 16 - to accept only gzip wrapper
+    if (inflateInit2(&m_stream, MAX_WBITS + 16) != Z_OK) {
+      throw SourceError("failed to initialize gzip decompression");
+    }
+  }
+  ~GzipDecompressor() override { inflateEnd(&m_stream); }
+
+  size_t Read(char *buffer, const size_t size) override {
+    m_stream.next_out = reinterpret_cast<Bytef *>(buffer);
+    m_stream.avail_out = static_cast<uInt>(size);
+    while (m_stream.avail_out) {
+      if (!m_stream.avail_in) {
+        if (!ReadInput()) {
+          if (!m_isMemberEnd) {
+            throw SourceError("gzip source is truncated");
+          }
+          break;
+        }
+        m_stream.next_in =
+            reinterpret_cast<Bytef *>(const_cast<char *>(GetInput()));
+        m_stream.avail_in = static_cast<uInt>(GetInputSize());
+      }
+      if (m_isMemberEnd) {
+        if (std::all_of(m_stream.next_in, m_stream.next_in + m_stream.avail_in,
+                        [](const Bytef byte) { return byte == 0; })) {
+          // zero padding after the last member, as from tape or block tools
+          m_stream.avail_in = 0;
+          m_isPadding = true;
+          continue;
+        }
+        if (m_isPadding) {
+          throw SourceError("unexpected data after gzip padding");
+        }
+        // file has several concatenated gzip members
+        if (inflateReset(&m_stream) != Z_OK) {
+          throw SourceError("failed to reset gzip decompression");
+        }
+        m_isMemberEnd = false;
+      }
+      const auto result = inflate(&m_stream, Z_NO_FLUSH);
+      if (result == Z_STREAM_END) {
+        m_isMemberEnd = true;
+      } else if (result != Z_OK) {
+        throw SourceError(std::string("failed to decompress gzip source: ") +
+                          (m_stream.msg ? m_stream.msg : "unknown error"));
+      }
+    }
+    return size - m_stream.avail_out;
+  }
+
+ private:
+  z_stream m_stream{};
+  bool m_isMemberEnd = false;
+  bool m_isPadding = false;
+};
+
+#ifdef ADAPT_WITH_ZSTD
+class ZstdDecompressor : public Decompressor {
+ public:
+  explicit ZstdDecompressor(std::unique_ptr<std::istream> source)
+      : Decompressor(std::move(source)), m_stream(ZSTD_createDStream()) {
+    if (!m_stream) {
+      throw SourceError("failed to initialize zstd decompression");
+    }
+  }
+  ~ZstdDecompressor() override { ZSTD_freeDStream(m_stream); }
+
+  size_t Read(char *buffer, const size_t size) override {
+    ZSTD_outBuffer output{buffer, size, 0};
+    while (output.pos < output.size) {
+      bool isInputEnd = false;
+      if (m_input.pos == m_input.size) {
+        if (ReadInput()) {
+          m_input = {GetInput(), GetInputSize(), 0};
+        } else {
+          isInputEnd = true;
+        }
+      }
+      if (isInputEnd && !m_hint) {
+        // all frames are finished and flushed
+        break;
+      }
+      const auto outputPos = output.pos;
+      m_hint = ZSTD_decompressStream(m_stream, &output, &m_input);
+      if (ZSTD_isError(m_hint)) {
+        throw SourceError(std::string("failed to decompress zstd source: ") +
+                          ZSTD_getErrorName(m_hint));
+      }
+      if (isInputEnd && output.pos == outputPos) {
+        throw SourceError("zstd source is truncated");
+      }
+    }
+    return output.pos;
+  }
+
+ private:
+  ZSTD_DStream *const m_stream;
+  ZSTD_inBuffer m_input{nullptr, 0, 0};
+  // zero - if the last frame is finished and flushed
+  size_t m_hint = 1;
+};
+#endif
+
+// Stream buffer which gets decompressed blocks from the helper thread. Blocks
+// are reused: the block is returned to the helper thread as soon as the parser
+// has read it.
+class DecompressingBuffer : public std::streambuf {
+ private:
+  struct Block {
+    std::vector<char> data = std::vector<char>(blockSize);
+    size_t size = 0;
+  };
+
+ public:
+  explicit DecompressingBuffer(std::unique_ptr<Decompressor> decompressor)
+      : m_decompressor(std::move(decompressor)) {
+    for (auto &block : m_blocks) {
+      m_freeBlocks.push_back(&block);
+    }
+    m_thread = std::thread([this]() { Decompress(); });
+  }
+  DecompressingBuffer(DecompressingBuffer &&) = delete;
+  DecompressingBuffer(const DecompressingBuffer &) = delete;
+  DecompressingBuffer &operator=(DecompressingBuffer &&) = delete;
+  ~DecompressingBuffer() override {
+    {
+      const std::lock_guard<std::mutex> lock(m_mutex);
+      m_isStopped = true;
+    }
+    m_condition.notify_all();
+    m_thread.join();
+  }
+
+ protected:
+  int_type underflow() override {
+    if (gptr() < egptr()) {
+      return traits_type::to_int_type(*gptr());
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_currentBlock) {
+      m_freeBlocks.push_back(m_currentBlock);
+      m_currentBlock = nullptr;
+      m_condition.notify_all();
+    }
+    m_condition.wait(
+        lock, [this]() { return !m_filledBlocks.empty() || m_isFinished; });
+    if (m_filledBlocks.empty()) {
+      setg(nullptr, nullptr, nullptr);
+      if (m_error) {
+        std::rethrow_exception(m_error);
+      }
+      return traits_type::eof();
+    }
+    m_currentBlock = m_filledBlocks.front();
+    m_filledBlocks.pop_front();
+    lock.unlock();
+
+    auto *const begin = m_currentBlock->data.data();
+    setg(begin, begin, begin + m_currentBlock->size);
+    return traits_type::to_int_type(*gptr());
+  }
+
+ private:
+  void Decompress() {
+    try {
+      for (;;) {
+        Block *block;
+        {
+          std::unique_lock<std::mutex> lock(m_mutex);
+          m_condition.wait(
+              lock, [this]() { return !m_freeBlocks.empty() || m_isStopped; });
+          if (m_isStopped) {
+            return;
+          }
+          block = m_freeBlocks.front();
+          m_freeBlocks.pop_front();
+        }
+        block->size =
+            m_decompressor->Read(block->data.data(), block->data.size());
+        {
+          const std::lock_guard<std::mutex> lock(m_mutex);
+          if (block->size) {
+            m_filledBlocks.push_back(block);
+          } else {
+            m_freeBlocks.push_back(block);
+            m_isFinished = true;
+          }
+        }
+        m_condition.notify_all();
+        if (!block->size) {
+          return;
+        }
+      }
+    } catch (...) {
+      {
+        const std::lock_guard<std::mutex> lock(m_mutex);
+        m_error = std::current_exception();
+        m_isFinished = true;
+      }
+      m_condition.notify_all();
+    }
+  }
+
+ private:
+  const std::unique_ptr<Decompressor> m_decompressor;
+
+  std::array<Block, numberOfBlocks> m_blocks;
+  Block *m_currentBlock = nullptr;
+
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::deque<Block *> m_freeBlocks;
+  std::deque<Block *> m_filledBlocks;
+  bool m_isFinished = false;
+  bool m_isStopped = false;
+  std::exception_ptr m_error;
+
+  std::thread m_thread;
+};
+
+class DecompressingStream : public std::istream {
+ public:
+  explicit DecompressingStream(std::unique_ptr<Decompressor> decompressor)
+      : std::istream(nullptr), m_buffer(std::move(decompressor)) {
+    rdbuf(&m_buffer);
+    // decompression errors have to be reported as is, not as the end of source
+    exceptions(badbit);
+  }
+  ~DecompressingStream() override = default;
+
+ private:
+  DecompressingBuffer m_buffer;
+};
+
+bool HasMagic(const std::array<unsigned char, 4> &header,
+              const size_t headerSize,
+              const std::initializer_list<unsigned char> &magic) {
+  return headerSize >= magic.size() &&
+         std::equal(magic.begin(), magic.end(), header.cbegin());
+}
+
+}  // namespace
+
+std::unique_ptr<std::istream> adapt::OpenSource(const char *path) {
+  auto file = std::make_unique<std::ifstream>(path, std::ios::binary);
+  if (!*file) {
+    return nullptr;
+  }
+
+  std::array<unsigned char, 4> header{};
+  file->read(reinterpret_cast<char *>(header.data()), header.size());
+  const auto headerSize = static_cast<size_t>(file->gcount());
+
+  if (HasMagic(header, headerSize, {0x1f, 0x8b})) {
+    file->clear();
+    file->seekg(0);
+    return std::make_unique<DecompressingStream>(
+        std::make_unique<GzipDecompressor>(std::move(file)));
+  }
+
+  if (HasMagic(header, headerSize, {0x28, 0xb5, 0x2f, 0xfd})) {
+#ifdef ADAPT_WITH_ZSTD
+    file->clear();
+    file->seekg(0);
+    return std::make_unique<DecompressingStream>(
+        std::make_unique<ZstdDecompressor>(std::move(file)));
+#else
+    throw SourceError("source is compressed by zstd, but zstd support is off");
+#endif
+  }
+
+  // plain text source is read as before, without helper thread
+  file = std::make_unique<std::ifstream>(path);
+  if (!*file) {
+    return nullptr;
+  }
+  return file;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "Exception.hpp"
+
+#include <istream>
+#include <memory>
+
+namespace adapt {
+
+class SourceError : public Exception {
+ public:
+  using Exception::Exception;
+  ~SourceError() override = default;
+
+  const char *what() const noexcept override { return "SOURCE ERROR"; }
+};
+
+// Opens source file by path. Detects gzip or zstd compression by magic bytes
+// and, if the file is compressed, returns stream which decompresses it on the
+// fly at a helper thread, so the parser reads plain text without temporary
+// files. Returns nullptr if the file could not be opened.
+std::unique_ptr<std::istream> OpenSource(const char *path);
+
+}  // namespace adapt